@@ -0,0 +1,43 @@
+#include <stdio.h>
+
+@table(name, start, kind, str) RegionTable
+{
+    { Kernel 0xffff800000000000 "system" "Kernel" }
+    { Text   0x400000           "user"   "Program text" }
+    { Heap   0x1000000          "user"   "Heap" }
+    { Null   0x0                "system" "Null page" }
+    { Stack  0x7ffff0000000     "user"   "Stack" }
+}
+
+typedef enum {
+@expand(RegionTable r)
+`    Region_$(r.name),`
+    Region_Count
+} Region;
+
+Region UserRegions[] = {
+@expand(RegionTable r sort(start) where(kind "user"))
+`    Region_$(r.name),`
+};
+
+@table_gen_string_pool(RegionTable str lengths) RegionString
+
+@table_gen_eytzinger(RegionTable start) RegionStart
+
+int
+main(int Argc, char *Args[])
+{
+    for (int RegionAt = 0;
+         RegionAt < sizeof(UserRegions)/sizeof(*UserRegions);
+         RegionAt++)
+    {
+        Region Region = UserRegions[RegionAt];
+        printf("user: %.*s\n", (int)RegionString_Lengths[Region], RegionString_Pool + RegionString_Offsets[Region]);
+    }
+    
+    // NOTE(luca): The first region starting at or after the address.
+    Region Region = RegionStart_LowerBound(0x500000);
+    printf("@: %s\n", RegionString_Pool + RegionString_Offsets[Region]);
+    
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+
+
+
+typedef enum {
+    Region_Kernel,
+    Region_Text,
+    Region_Heap,
+    Region_Null,
+    Region_Stack,
+    Region_Count
+} Region;
+
+Region UserRegions[] = {
+    Region_Text,
+    Region_Heap,
+    Region_Stack,
+};
+
+const char RegionString_Pool[] =
+    "Kernel\0"
+    "Program text\0"
+    "Heap\0"
+    "Null page\0"
+    "Stack\0"
+;
+
+const unsigned int RegionString_Offsets[] = {
+    0, 7, 20, 25, 35,
+};
+
+const unsigned int RegionString_Lengths[] = {
+    6, 12, 4, 9, 5,
+};
+
+
+#if defined(_MSC_VER)
+__declspec(align(64))
+#elif defined(__GNUC__)
+__attribute__((aligned(64)))
+#else
+_Alignas(64)
+#endif
+const unsigned long long RegionStart_Keys[6] = {
+    0x0ULL, 0x7ffff0000000ULL, 0x400000ULL, 0xffff800000000000ULL, 0x0ULL, 0x1000000ULL,
+};
+
+const unsigned int RegionStart_Rows[6] = {
+    5, 4, 1, 0, 3, 2,
+};
+
+static inline unsigned int
+RegionStart_LowerBound(unsigned long long Key)
+{
+    unsigned int At = 1;
+    while (At <= 5)
+    {
+#if defined(__GNUC__)
+        // NOTE: Deliberately points past the end of Keys near the leaves,
+        // a prefetch never faults.
+        __builtin_prefetch(RegionStart_Keys + 8 * At);
+#endif
+        At = 2 * At + (RegionStart_Keys[At] < Key);
+    }
+#if defined(__GNUC__)
+    At >>= __builtin_ffs(~At);
+#else
+    while (At & 1) At >>= 1;
+    At >>= 1;
+#endif
+    return RegionStart_Rows[At];
+}
+
+
+int
+main(int Argc, char *Args[])
+{
+    for (int RegionAt = 0;
+         RegionAt < sizeof(UserRegions)/sizeof(*UserRegions);
+         RegionAt++)
+    {
+        Region Region = UserRegions[RegionAt];
+        printf("user: %.*s\n", (int)RegionString_Lengths[Region], RegionString_Pool + RegionString_Offsets[Region]);
+    }
+    
+    // NOTE(luca): The first region starting at or after the address.
+    Region Region = RegionStart_LowerBound(0x500000);
+    printf("@: %s\n", RegionString_Pool + RegionString_Offsets[Region]);
+    
+    return 0;
+}
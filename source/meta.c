@@ -29,6 +29,7 @@ typedef int8_t   i8;
 typedef int16_t  i16;
 typedef int32_t  i32;
 typedef int64_t  i64;
+typedef double   f64;
 typedef u32      b32;
 #define true     1
 #define false    0
@@ -87,8 +88,20 @@ struct table {
     s8 *Labels;
     i32 ElementsCount;
     s8 *Elements;
+    struct column_index *Indexes;
 };
 typedef struct table table;
+#define TableElement(Table, Row, Label) ((Table)->Elements[(Row) * (Table)->LabelsCount + (Label)])
+
+// NOTE(luca): Built lazily the first time an expansion sorts or filters on a column, then reused
+// by every following expansion over the same table and column.
+struct column_index {
+    b32 IsBuilt;
+    i32 *Rows;        // Row numbers ordered by the column's value, equal values keep declaration order.
+    i32 GroupsCount;
+    i32 *GroupStarts; // Index into Rows of the first row of each distinct value.
+};
+typedef struct column_index column_index;
 
 struct parse_result {
     u64 End;
@@ -97,6 +110,31 @@ struct parse_result {
 };
 typedef struct parse_result parse_result;
 
+struct integer {
+    b32 IsNegative;
+    b32 IsOverflow;
+    b32 IsUnsigned; // Has a 'u' suffix.
+    u64 Magnitude;
+};
+typedef struct integer integer;
+
+struct number {
+    b32 IsInteger;
+    integer Integer;
+    f64 Float;
+};
+typedef struct number number;
+
+// NOTE(luca): The `(Table label [option]) Name` that follows the table_gen_* keywords.
+struct directive_header {
+    table *Table;
+    i32 LabelIndex;
+    s8 Option;
+    u64 OptionAt;
+    s8 Name;
+};
+typedef struct directive_header directive_header;
+
 struct error {
     u64 At;
     u64 Size;
@@ -109,7 +147,12 @@ typedef struct error error;
 // TODO: use meta program to generate Keywords table
 global_variable s8 TableKeyword = S8_LIT("table");
 global_variable s8 TableGenEnumKeyword = S8_LIT("table_gen_enum");
+global_variable s8 TableGenStringPoolKeyword = S8_LIT("table_gen_string_pool");
+global_variable s8 LengthsKeyword = S8_LIT("lengths");
+global_variable s8 TableGenEytzingerKeyword = S8_LIT("table_gen_eytzinger");
 global_variable s8 ExpandKeyword = S8_LIT("expand");
+global_variable s8 SortKeyword = S8_LIT("sort");
+global_variable s8 WhereKeyword = S8_LIT("where");
 ////////////////////////////////////////////////////////
 
 ///~ MetaC functions ///////////////////////////////////
@@ -155,6 +198,14 @@ IsWhitespace(char Ch)
            Ch == '\t');
 }
 
+i32
+IsHexDigit(char Ch)
+{
+    return((Ch >= '0' && Ch <= '9') ||
+           (Ch >= 'a' && Ch <= 'f') ||
+           (Ch >= 'A' && Ch <= 'F'));
+}
+
 parse_result
 ParseUntilChar(u8 *In, u64 InSize, u64 At, char Ch, arena *ErrorsArena)
 {
@@ -212,6 +263,628 @@ StringArenaPush(arena *Arena, char *Source, u64 Size)
     Memcpy((char *)Pos, Source, Size);
     return Pos;
 }
+
+b32
+S8Match(s8 A, s8 B)
+{
+    return (A.Size == B.Size && !strncmp(A.Data, B.Data, A.Size));
+}
+
+table *
+TableFindByName(table *Tables, u32 TablesCount, s8 Name)
+{
+    table *Result = 0;
+    
+    for (u32 TableAt = 0;
+         TableAt < TablesCount;
+         TableAt++)
+    {
+        if (S8Match(Tables[TableAt].Name, Name))
+        {
+            Result = Tables + TableAt;
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+i32
+TableLabelIndex(table *Table, s8 Label)
+{
+    i32 Result = -1;
+    
+    for (i32 LabelAt = 0;
+         LabelAt < Table->LabelsCount;
+         LabelAt++)
+    {
+        if (S8Match(Table->Labels[LabelAt], Label))
+        {
+            Result = LabelAt;
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+// NOTE(luca): Reads integer literals the way C does, with an optional sign and integer suffixes,
+// eg. -12, 0x1F, 017, 0b101, 42u.  Returns false when String is not an integer literal, a literal
+// that does not fit in 64 bits is flagged through IsOverflow and compares as text.
+b32
+ParseInteger(s8 String, integer *Value)
+{
+    b32 Result = false;
+    u64 At = 0;
+    u64 Base = 10;
+    integer Integer = {0};
+    
+    if (At < String.Size && (String.Data[At] == '-' || String.Data[At] == '+'))
+    {
+        Integer.IsNegative = (String.Data[At] == '-');
+        At++;
+    }
+    
+    u64 DigitsAt = At;
+    if (At + 1 < String.Size && String.Data[At] == '0')
+    {
+        char Prefix = String.Data[At + 1];
+        if (Prefix == 'x' || Prefix == 'X')
+        {
+            Base = 16;
+            At += 2;
+            DigitsAt = At;
+        }
+        else if (Prefix == 'b' || Prefix == 'B')
+        {
+            Base = 2;
+            At += 2;
+            DigitsAt = At;
+        }
+        else
+        {
+            // NOTE(luca): The leading 0 counts as a digit so that "0u" stays valid.
+            Base = 8;
+        }
+    }
+    
+    for (;
+         At < String.Size;
+         At++)
+    {
+        char Ch = String.Data[At];
+        u64 Digit = Base;
+        if (Ch >= '0' && Ch <= '9')      Digit = Ch - '0';
+        else if (Ch >= 'a' && Ch <= 'f') Digit = Ch - 'a' + 10;
+        else if (Ch >= 'A' && Ch <= 'F') Digit = Ch - 'A' + 10;
+        
+        if (Digit >= Base) break;
+        
+        if (Integer.Magnitude > (UINT64_MAX - Digit) / Base)
+        {
+            Integer.IsOverflow = true;
+        }
+        Integer.Magnitude = Integer.Magnitude * Base + Digit;
+    }
+    
+    if (At > DigitsAt)
+    {
+        while (At < String.Size &&
+               (String.Data[At] == 'u' || String.Data[At] == 'U' ||
+                String.Data[At] == 'l' || String.Data[At] == 'L'))
+        {
+            Integer.IsUnsigned |= (String.Data[At] == 'u' || String.Data[At] == 'U');
+            At++;
+        }
+        
+        if (At == String.Size)
+        {
+            if (Integer.IsNegative && Integer.Magnitude > (u64)INT64_MAX + 1)
+            {
+                Integer.IsOverflow = true;
+            }
+            Integer.IsNegative = (Integer.IsNegative && Integer.Magnitude);
+            *Value = Integer;
+            Result = true;
+        }
+    }
+    
+    return Result;
+}
+
+i32
+IntegerCompare(integer A, integer B)
+{
+    i32 Result = 0;
+    
+    if (A.IsNegative != B.IsNegative)
+    {
+        Result = (A.IsNegative) ? -1 : 1;
+    }
+    else
+    {
+        Result = (A.Magnitude > B.Magnitude) - (A.Magnitude < B.Magnitude);
+        if (A.IsNegative) Result = -Result;
+    }
+    
+    return Result;
+}
+
+// NOTE(luca): Reads floating literals the way C does, with an optional sign and suffix, eg. 1.5,
+// -2e3, .5f, 0x1.8p3.  Integer literals are left to ParseInteger.
+b32
+ParseFloat(s8 String, f64 *Value)
+{
+    b32 Result = false;
+    char Buffer[64];
+    u64 At = 0;
+    u64 Size = String.Size;
+    
+    if (Size && Size < sizeof(Buffer))
+    {
+        if (String.Data[At] == '-' || String.Data[At] == '+') At++;
+        b32 IsHex = (At + 1 < Size && String.Data[At] == '0' &&
+                     (String.Data[At + 1] == 'x' || String.Data[At + 1] == 'X'));
+        b32 StartsWithDigit = (At < Size &&
+                               ((String.Data[At] >= '0' && String.Data[At] <= '9') || String.Data[At] == '.'));
+        
+        char Last = String.Data[Size - 1];
+        if (Last == 'f' || Last == 'F' || Last == 'l' || Last == 'L') Size--;
+        
+        // NOTE(luca): Hexadecimal floats need an exponent, decimal ones a '.' or an exponent.
+        b32 IsFloat = false;
+        for (u64 CharAt = At;
+             CharAt < Size;
+             CharAt++)
+        {
+            char Ch = String.Data[CharAt];
+            if (IsHex) IsFloat |= (Ch == 'p' || Ch == 'P');
+            else       IsFloat |= (Ch == '.' || Ch == 'e' || Ch == 'E');
+        }
+        
+        if (IsFloat && StartsWithDigit)
+        {
+            memcpy(Buffer, String.Data, Size);
+            Buffer[Size] = 0;
+            char *End = 0;
+            f64 Float = strtod(Buffer, &End);
+            if (End == Buffer + Size)
+            {
+                *Value = Float;
+                Result = true;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+b32
+ParseNumber(s8 String, number *Value)
+{
+    b32 Result = false;
+    
+    if (ParseInteger(String, &Value->Integer) && !Value->Integer.IsOverflow)
+    {
+        Value->IsInteger = true;
+        Result = true;
+    }
+    else if (ParseFloat(String, &Value->Float))
+    {
+        Value->IsInteger = false;
+        Result = true;
+    }
+    
+    return Result;
+}
+
+// NOTE(luca): Compares exactly, without rounding the integer to a double.
+i32
+FloatIntegerCompare(f64 A, integer B)
+{
+    i32 Result = 0;
+    
+    if (A >= 18446744073709551616.0)
+    {
+        Result = 1;
+    }
+    else if (A <= -18446744073709551616.0)
+    {
+        Result = -1;
+    }
+    else
+    {
+        f64 Magnitude = (A < 0) ? -A : A;
+        integer Whole = {0};
+        Whole.Magnitude = (u64)Magnitude;
+        Whole.IsNegative = (A < 0 && Whole.Magnitude);
+        
+        Result = IntegerCompare(Whole, B);
+        if (!Result && Magnitude > (f64)Whole.Magnitude)
+        {
+            Result = (A < 0) ? -1 : 1;
+        }
+    }
+    
+    return Result;
+}
+
+i32
+NumberCompare(number A, number B)
+{
+    i32 Result = 0;
+    
+    if (A.IsInteger && B.IsInteger)
+    {
+        Result = IntegerCompare(A.Integer, B.Integer);
+    }
+    else if (A.IsInteger)
+    {
+        Result = -FloatIntegerCompare(B.Float, A.Integer);
+    }
+    else if (B.IsInteger)
+    {
+        Result = FloatIntegerCompare(A.Float, B.Integer);
+    }
+    else
+    {
+        Result = (A.Float > B.Float) - (A.Float < B.Float);
+    }
+    
+    return Result;
+}
+
+// NOTE(luca): Every number orders before every non-number.  Integer and floating literals compare
+// by value, anything else compares by its bytes.
+i32
+ElementCompare(s8 A, s8 B)
+{
+    i32 Result = 0;
+    number ValueA = {0};
+    number ValueB = {0};
+    b32 IsNumberA = ParseNumber(A, &ValueA);
+    b32 IsNumberB = ParseNumber(B, &ValueB);
+    
+    if (IsNumberA != IsNumberB)
+    {
+        Result = (IsNumberA) ? -1 : 1;
+    }
+    else if (IsNumberA)
+    {
+        Result = NumberCompare(ValueA, ValueB);
+    }
+    else
+    {
+        u64 Size = (A.Size < B.Size) ? A.Size : B.Size;
+        Result = memcmp(A.Data, B.Data, Size);
+        if (!Result)
+        {
+            Result = (A.Size > B.Size) - (A.Size < B.Size);
+        }
+    }
+    
+    return Result;
+}
+
+// NOTE(luca): Bottom-up merge sort so rows with equal values stay in declaration order.
+void
+SortRowsByLabel(table *Table, i32 LabelIndex, i32 *Rows, i32 *Temp, i32 Count)
+{
+    for (i32 Width = 1;
+         Width < Count;
+         Width *= 2)
+    {
+        for (i32 Low = 0;
+             Low < Count;
+             Low += 2 * Width)
+        {
+            i32 Middle = (Low + Width < Count) ? Low + Width : Count;
+            i32 High = (Low + 2 * Width < Count) ? Low + 2 * Width : Count;
+            i32 Left = Low;
+            i32 Right = Middle;
+            
+            for (i32 TempAt = Low;
+                 TempAt < High;
+                 TempAt++)
+            {
+                if (Left < Middle &&
+                    (Right >= High ||
+                     ElementCompare(TableElement(Table, Rows[Left], LabelIndex),
+                                    TableElement(Table, Rows[Right], LabelIndex)) <= 0))
+                {
+                    Temp[TempAt] = Rows[Left++];
+                }
+                else
+                {
+                    Temp[TempAt] = Rows[Right++];
+                }
+            }
+        }
+        
+        memcpy(Rows, Temp, sizeof(*Rows) * Count);
+    }
+}
+
+column_index *
+TableColumnIndex(arena *Arena, table *Table, i32 LabelIndex)
+{
+    if (!Table->Indexes)
+    {
+        Table->Indexes = (column_index *)ArenaPush(Arena, sizeof(*Table->Indexes) * Table->LabelsCount);
+        memset(Table->Indexes, 0, sizeof(*Table->Indexes) * Table->LabelsCount);
+    }
+    
+    column_index *Index = Table->Indexes + LabelIndex;
+    if (!Index->IsBuilt)
+    {
+        i32 Count = Table->ElementsCount;
+        
+        Index->GroupStarts = (i32 *)ArenaPush(Arena, sizeof(*Index->GroupStarts) * Count);
+        Index->Rows = (i32 *)ArenaPush(Arena, sizeof(*Index->Rows) * Count);
+        for (i32 RowAt = 0;
+             RowAt < Count;
+             RowAt++)
+        {
+            Index->Rows[RowAt] = RowAt;
+        }
+        
+        i32 *Temp = (i32 *)ArenaPush(Arena, sizeof(*Temp) * Count);
+        SortRowsByLabel(Table, LabelIndex, Index->Rows, Temp, Count);
+        ArenaPop(Arena, sizeof(*Temp) * Count);
+        
+        for (i32 RowAt = 0;
+             RowAt < Count;
+             RowAt++)
+        {
+            if (RowAt == 0 ||
+                ElementCompare(TableElement(Table, Index->Rows[RowAt - 1], LabelIndex),
+                               TableElement(Table, Index->Rows[RowAt], LabelIndex)))
+            {
+                Index->GroupStarts[Index->GroupsCount++] = RowAt;
+            }
+        }
+        
+        Index->IsBuilt = true;
+    }
+    
+    return Index;
+}
+
+// NOTE(luca): Lays out rows that are in sorted order in Eytzinger (breadth first) order, where the
+// children of slot K are at 2K and 2K + 1.  Slots start at 1, returns the next row to place.
+i32
+EytzingerFill(i32 *SortedRows, i32 *Slots, i32 SortedAt, i32 Slot, i32 Count)
+{
+    if (Slot <= Count)
+    {
+        SortedAt = EytzingerFill(SortedRows, Slots, SortedAt, 2 * Slot, Count);
+        Slots[Slot] = SortedRows[SortedAt++];
+        SortedAt = EytzingerFill(SortedRows, Slots, SortedAt, 2 * Slot + 1, Count);
+    }
+    
+    return SortedAt;
+}
+
+// NOTE(luca): Elements written as "..." are C string literals and are copied into the pool as
+// they are.  Anything else is taken as the raw text.
+b32
+IsStringLiteral(s8 Element)
+{
+    return (Element.Size >= 2 && Element.Data[0] == '"' && Element.Data[Element.Size - 1] == '"');
+}
+
+// NOTE(luca): Writes the bytes the compiler stores for Element to Out, when Out is not 0, and
+// returns how many there are.  Universal character names are stored as UTF-8.
+u64
+StringElementDecode(s8 Element, char *Out)
+{
+    u64 Result = 0;
+    
+    if (!IsStringLiteral(Element))
+    {
+        if (Out) memcpy(Out, Element.Data, Element.Size);
+        Result = Element.Size;
+    }
+    else
+    {
+        u64 End = Element.Size - 1;
+        for (u64 At = 1;
+             At < End;
+             At++)
+        {
+            u32 Value = (u8)Element.Data[At];
+            b32 IsCodePoint = false;
+            
+            if (Element.Data[At] == '\\' && At + 1 < End)
+            {
+                At++;
+                char Ch = Element.Data[At];
+                switch (Ch)
+                {
+                    case 'a': Value = '\a'; break;
+                    case 'b': Value = '\b'; break;
+                    case 'f': Value = '\f'; break;
+                    case 'n': Value = '\n'; break;
+                    case 'r': Value = '\r'; break;
+                    case 't': Value = '\t'; break;
+                    case 'v': Value = '\v'; break;
+                    
+                    case 'x':
+                    case 'u':
+                    case 'U':
+                    {
+                        u32 DigitsMax = (Ch == 'x') ? 0xFFFFFFFF : (Ch == 'u') ? 4 : 8;
+                        IsCodePoint = (Ch != 'x');
+                        Value = 0;
+                        for (u32 DigitsCount = 0;
+                             DigitsCount < DigitsMax && At + 1 < End && IsHexDigit(Element.Data[At + 1]);
+                             DigitsCount++)
+                        {
+                            char Digit = Element.Data[++At];
+                            Value = Value * 16 + ((Digit <= '9') ? Digit - '0' : (Digit | 0x20) - 'a' + 10);
+                        }
+                    } break;
+                    
+                    default:
+                    {
+                        Value = (u8)Ch;
+                        if (Ch >= '0' && Ch <= '7')
+                        {
+                            Value = Ch - '0';
+                            for (u32 DigitsCount = 1;
+                                 (DigitsCount < 3 && At + 1 < End &&
+                                  Element.Data[At + 1] >= '0' && Element.Data[At + 1] <= '7');
+                                 DigitsCount++)
+                            {
+                                Value = Value * 8 + (Element.Data[++At] - '0');
+                            }
+                        }
+                    } break;
+                }
+            }
+            
+            u8 Bytes[4] = { (u8)Value };
+            u32 BytesCount = 1;
+            if (IsCodePoint && Value >= 0x80)
+            {
+                if (Value < 0x800)
+                {
+                    Bytes[0] = 0xC0 | (Value >> 6);
+                    BytesCount = 2;
+                }
+                else if (Value < 0x10000)
+                {
+                    Bytes[0] = 0xE0 | (Value >> 12);
+                    BytesCount = 3;
+                }
+                else
+                {
+                    Bytes[0] = 0xF0 | (Value >> 18);
+                    BytesCount = 4;
+                }
+                for (u32 ByteAt = 1;
+                     ByteAt < BytesCount;
+                     ByteAt++)
+                {
+                    Bytes[ByteAt] = 0x80 | ((Value >> (6 * (BytesCount - 1 - ByteAt))) & 0x3F);
+                }
+            }
+            
+            if (Out) memcpy(Out + Result, Bytes, BytesCount);
+            Result += BytesCount;
+        }
+    }
+    
+    return Result;
+}
+
+char *
+StringElementWrite(char *Out, s8 Element)
+{
+    if (IsStringLiteral(Element))
+    {
+        memcpy(Out, Element.Data + 1, Element.Size - 2);
+        Out += Element.Size - 2;
+    }
+    else
+    {
+        for (u64 At = 0;
+             At < Element.Size;
+             At++)
+        {
+            if (Element.Data[At] == '"' || Element.Data[At] == '\\') *Out++ = '\\';
+            *Out++ = Element.Data[At];
+        }
+    }
+    
+    return Out;
+}
+
+// NOTE(luca): Returns the group whose value equals Value, or -1 when no row matches.
+i32
+ColumnIndexFindGroup(table *Table, i32 LabelIndex, column_index *Index, s8 Value)
+{
+    i32 Result = -1;
+    i32 Low = 0;
+    i32 High = Index->GroupsCount;
+    
+    while (Low < High)
+    {
+        i32 Middle = Low + (High - Low) / 2;
+        i32 Row = Index->Rows[Index->GroupStarts[Middle]];
+        i32 Compare = ElementCompare(TableElement(Table, Row, LabelIndex), Value);
+        if (Compare < 0)
+        {
+            Low = Middle + 1;
+        }
+        else if (Compare > 0)
+        {
+            High = Middle;
+        }
+        else
+        {
+            Result = Middle;
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+// NOTE(luca): At is on the '(' after the keyword.  Returns the position of the last character of
+// the name, so that the whitespace following it is kept in the output.
+u64
+ParseDirectiveHeader(char *In, u64 InSize, u64 At, table *Tables, u32 TablesCount,
+                     arena *ErrorsArena, directive_header *Header)
+{
+    Header->Table = 0;
+    Header->LabelIndex = -1;
+    
+    ErrorPushAssert(In[At] == '(', ErrorsArena, At, S8_SIZE_DATA("expected '('"));
+    At++;
+    
+    // @compress_parse
+    while (IsWhitespace(In[At]) && At < InSize) At++;
+    u64 TableNameAt = At;
+    while (!IsWhitespace(In[At]) && In[At] != ')' && At < InSize) At++;
+    s8 TableName = { In + TableNameAt, At - TableNameAt };
+    ErrorPushAssert(TableName.Size, ErrorsArena, At, S8_SIZE_DATA("table name required"));
+    Header->Table = TableFindByName(Tables, TablesCount, TableName);
+    ErrorPushAssert(Header->Table != 0, ErrorsArena, TableNameAt, S8_SIZE_DATA("undefined table name"));
+    
+    // @compress_parse
+    while (IsWhitespace(In[At]) && At < InSize) At++;
+    u64 LabelAt = At;
+    while (!IsWhitespace(In[At]) && In[At] != ')' && At < InSize) At++;
+    s8 Label = { In + LabelAt, At - LabelAt };
+    ErrorPushAssert(Label.Size, ErrorsArena, At, S8_SIZE_DATA("label required"));
+    if (Header->Table)
+    {
+        Header->LabelIndex = TableLabelIndex(Header->Table, Label);
+        ErrorPushAssert(Header->LabelIndex != -1, ErrorsArena, LabelAt, S8_SIZE_DATA("undefined label"));
+    }
+    
+    // @compress_parse
+    while (IsWhitespace(In[At]) && At < InSize) At++;
+    Header->OptionAt = At;
+    while (!IsWhitespace(In[At]) && In[At] != ')' && At < InSize) At++;
+    Header->Option.Data = In + Header->OptionAt;
+    Header->Option.Size = At - Header->OptionAt;
+    
+    while (IsWhitespace(In[At]) && At < InSize) At++;
+    ErrorPushAssert(In[At] == ')' && At < InSize, ErrorsArena, At, S8_SIZE_DATA("expected ')'"));
+    At++;
+    
+    // @compress_parse
+    while (IsWhitespace(In[At]) && At < InSize) At++;
+    u64 NameAt = At;
+    while (!IsWhitespace(In[At]) && At < InSize) At++;
+    ErrorPushAssert(At > NameAt, ErrorsArena, NameAt, S8_SIZE_DATA("name required"));
+    Header->Name.Data = In + NameAt;
+    Header->Name.Size = At - NameAt;
+    
+    return At - 1;
+}
 ////////////////////////////////////////////////////////
 
 int
@@ -305,6 +978,7 @@ main(int ArgC, char *Args[])
             
             if (!strncmp(In + At, S8_ARG(ExpandKeyword)))
             {
+                i32 ExpandAt = At - 1;
                 if (TablesCount == 0)
                 {
                     ErrorPush(&ErrorsArena, At, S8_SIZE_DATA("no tables defined"));
@@ -331,35 +1005,89 @@ main(int ArgC, char *Args[])
                 ExpressionTableName.Data = In + ExpressionTableNameAt;
                 ExpressionTableName.Size = At - ExpressionTableNameAt;
                 
-                for (i32 TableAt = 0;
-                     TableAt < TablesCount;
-                     TableAt++)
-                {
-                    if (ExpressionTableName.Size == Tables[TableAt].Name.Size && !strncmp(Tables[TableAt].Name.Data, ExpressionTableName.Data, ExpressionTableName.Size))
-                    {
-                        ExpressionTable = Tables + TableAt;
-                        break;
-                    }
-                }
+                ExpressionTable = TableFindByName(Tables, TablesCount, ExpressionTableName);
                 ErrorPushAssert(ExpressionTable != 0, &ErrorsArena, ExpressionTableNameAt, S8_SIZE_DATA("undefined table name"));
                 
                 while (IsWhitespace(In[At]) && At < InSize) At++;
                 ErrorPushAssert(At < InSize, &ErrorsArena, At, S8_SIZE_DATA("expected argument name"));
-                int ErrorAt = At;
                 
-                parse_result ParseResult = ParseUntilChar(In, InSize, At, ')', &ErrorsArena);
-                if (ParseResult.Size)
-                {
-                    ExpressionTableArgument.Size = ParseResult.Size;
-                    ExpressionTableArgument.Data = ParseResult.Data;
-                    At = ParseResult.End;
-                }
-                else
+                // @compress_parse
+                ExpressionTableArgumentAt = At;
+                while (!IsWhitespace(In[At]) && In[At] != ')' && At < InSize) At++;
+                ErrorPushAssert(At - ExpressionTableArgumentAt > 0, &ErrorsArena, ExpressionTableArgumentAt, S8_SIZE_DATA("argument name required"));
+                ExpressionTableArgument.Data = In + ExpressionTableArgumentAt;
+                ExpressionTableArgument.Size = At - ExpressionTableArgumentAt;
+                parse_result ParseResult = {0};
+                
+                // Parse the clauses, eg. `sort(name) where(kind "fruit")`.  They must end with ')' on
+                // the same line, so that a missing ')' does not swallow the expression.
+                i32 SortLabelIndex  = -1;
+                i32 WhereLabelIndex = -1;
+                s8  WhereValue      = {0};
+                b32 IsClosed        = false;
+                while (At < InSize)
                 {
-                    // TODO: Logging
+                    while ((In[At] == ' ' || In[At] == '\t') && At < InSize) At++;
+                    if (In[At] == ')' && At < InSize)
+                    {
+                        At++;
+                        IsClosed = true;
+                        break;
+                    }
+                    
+                    i32 ClauseAt = At;
+                    b32 IsSort = (At + SortKeyword.Size < InSize &&
+                                  !strncmp(In + At, S8_ARG(SortKeyword)) && In[At + SortKeyword.Size] == '(');
+                    b32 IsWhere = (At + WhereKeyword.Size < InSize &&
+                                   !strncmp(In + At, S8_ARG(WhereKeyword)) && In[At + WhereKeyword.Size] == '(');
+                    if (!IsSort && !IsWhere) break;
+                    At += ((IsSort) ? SortKeyword.Size : WhereKeyword.Size) + 1;
+                    
+                    // @compress_parse
+                    while ((In[At] == ' ' || In[At] == '\t') && At < InSize) At++;
+                    i32 ClauseLabelAt = At;
+                    while (!IsWhitespace(In[At]) && In[At] != ')' && In[At] != '`' && At < InSize) At++;
+                    s8 ClauseLabel = { In + ClauseLabelAt, At - ClauseLabelAt };
+                    
+                    while ((In[At] == ' ' || In[At] == '\t') && At < InSize) At++;
+                    i32 ClauseValueAt = At;
+                    while (In[At] != ')' && In[At] != '`' && In[At] != '\n' && At < InSize)
+                    {
+                        if (In[At] == '"' || In[At] == '\'')
+                        {
+                            char Quote = In[At++];
+                            while (In[At] != Quote && In[At] != '\n' && At < InSize) At++;
+                            if (In[At] == '\n') break;
+                        }
+                        At++;
+                    }
+                    if (In[At] != ')' || At >= InSize) break;
+                    s8 ClauseValue = { In + ClauseValueAt, At - ClauseValueAt };
+                    while (ClauseValue.Size && IsWhitespace(ClauseValue.Data[ClauseValue.Size - 1])) ClauseValue.Size--;
+                    At++;
+                    
+                    i32 LabelIndex = -1;
+                    if (ExpressionTable)
+                    {
+                        LabelIndex = TableLabelIndex(ExpressionTable, ClauseLabel);
+                        ErrorPushAssert(LabelIndex != -1, &ErrorsArena, ClauseLabelAt, S8_SIZE_DATA("undefined label"));
+                    }
+                    
+                    if (IsSort)
+                    {
+                        ErrorPushAssert(SortLabelIndex == -1, &ErrorsArena, ClauseAt, S8_SIZE_DATA("sort clause already given"));
+                        ErrorPushAssert(!ClauseValue.Size, &ErrorsArena, ClauseValueAt, S8_SIZE_DATA("sort expects a single label"));
+                        SortLabelIndex = LabelIndex;
+                    }
+                    else
+                    {
+                        ErrorPushAssert(WhereLabelIndex == -1, &ErrorsArena, ClauseAt, S8_SIZE_DATA("where clause already given"));
+                        ErrorPushAssert(ClauseValue.Size, &ErrorsArena, ClauseValueAt, S8_SIZE_DATA("where expects a label and a value"));
+                        WhereLabelIndex = LabelIndex;
+                        WhereValue = ClauseValue;
+                    }
                 }
-                
-                // Error(At > ExpressionTableArgumentAt, "argument name required", ExpressionTableArgumentAt);
+                ErrorPushAssert(IsClosed, &ErrorsArena, ExpandAt, S8_SIZE_DATA("expected ')'"));
                 
                 // @compress_parse
                 while (IsWhitespace(In[At]) && At < InSize) At++;
@@ -369,11 +1097,88 @@ main(int ArgC, char *Args[])
                 
                 if (ExpressionTable)
                 {
+                    column_index *SortIndex  = 0;
+                    column_index *WhereIndex = 0;
+                    if (SortLabelIndex != -1)
+                    {
+                        SortIndex = TableColumnIndex(&ScratchArena, ExpressionTable, SortLabelIndex);
+                    }
+                    if (WhereLabelIndex != -1)
+                    {
+                        WhereIndex = TableColumnIndex(&ScratchArena, ExpressionTable, WhereLabelIndex);
+                    }
+                    
+                    // NOTE(luca): Pushed after the indexes so it can be popped once expanded.
+                    u64 RowsSize = sizeof(i32) * ExpressionTable->ElementsCount;
+                    i32 *Rows = (i32 *)ArenaPush(&ScratchArena, RowsSize);
+                    i32 RowsCount = 0;
+                    if (WhereIndex)
+                    {
+                        i32 Group = ColumnIndexFindGroup(ExpressionTable, WhereLabelIndex, WhereIndex, WhereValue);
+                        if (Group != -1)
+                        {
+                            i32 GroupEnd = ((Group + 1 < WhereIndex->GroupsCount) ?
+                                            WhereIndex->GroupStarts[Group + 1] : ExpressionTable->ElementsCount);
+                            for (i32 RowAt = WhereIndex->GroupStarts[Group];
+                                 RowAt < GroupEnd;
+                                 RowAt++)
+                            {
+                                Rows[RowsCount++] = WhereIndex->Rows[RowAt];
+                            }
+                        }
+                    }
+                    
+                    if (SortIndex && WhereIndex)
+                    {
+                        // NOTE(luca): Mark the rows of the matching group, then keep them in sorted order.
+                        u64 IsMatchSize = sizeof(u8) * ExpressionTable->ElementsCount;
+                        u8 *IsMatch = (u8 *)ArenaPush(&ScratchArena, IsMatchSize);
+                        memset(IsMatch, 0, IsMatchSize);
+                        for (i32 RowAt = 0;
+                             RowAt < RowsCount;
+                             RowAt++)
+                        {
+                            IsMatch[Rows[RowAt]] = true;
+                        }
+                        
+                        RowsCount = 0;
+                        for (i32 RowAt = 0;
+                             RowAt < ExpressionTable->ElementsCount;
+                             RowAt++)
+                        {
+                            i32 Row = SortIndex->Rows[RowAt];
+                            if (IsMatch[Row])
+                            {
+                                Rows[RowsCount++] = Row;
+                            }
+                        }
+                        ArenaPop(&ScratchArena, IsMatchSize);
+                    }
+                    else if (SortIndex)
+                    {
+                        for (i32 RowAt = 0;
+                             RowAt < ExpressionTable->ElementsCount;
+                             RowAt++)
+                        {
+                            Rows[RowsCount++] = SortIndex->Rows[RowAt];
+                        }
+                    }
+                    else if (!WhereIndex)
+                    {
+                        for (i32 RowAt = 0;
+                             RowAt < ExpressionTable->ElementsCount;
+                             RowAt++)
+                        {
+                            Rows[RowsCount++] = RowAt;
+                        }
+                    }
+                    
                     i32 ExpressionAt = At;
-                    for (i32 ElementAt = 0;
-                         ElementAt < ExpressionTable->ElementsCount;
-                         ElementAt++)
+                    for (i32 RowAt = 0;
+                         RowAt < RowsCount;
+                         RowAt++)
                     {
+                        i32 ElementAt = Rows[RowAt];
                         At = ExpressionAt;
                         
                         while (In[At] != '`' && At < InSize)
@@ -446,11 +1251,279 @@ main(int ArgC, char *Args[])
                         *Out++ = '\n';
                         
                     }
+                    ArenaPop(&ScratchArena, RowsSize);
+                    
+                    if (!RowsCount)
+                    {
+                        // NOTE(luca): Nothing was expanded, skip over the expression.
+                        while (In[At] != '`' && At < InSize)
+                        {
+                            if (In[At] == '\\') At++;
+                            At++;
+                        }
+                    }
                     ErrorPushAssert(At < InSize, &ErrorsArena, ExpressionAt - 1, S8_SIZE_DATA("expected closing '`'") - 1);
                     
                     At++;
                 }
             }
+            else if (!strncmp(In + At, S8_ARG(TableGenStringPoolKeyword)))
+            {
+                directive_header Header = {0};
+                At += TableGenStringPoolKeyword.Size;
+                At = ParseDirectiveHeader(In, InSize, At, Tables, TablesCount, &ErrorsArena, &Header);
+                
+                table *PoolTable   = Header.Table;
+                i32 PoolLabelIndex = Header.LabelIndex;
+                s8 PoolName        = Header.Name;
+                b32 WithLengths    = false;
+                if (Header.Option.Size)
+                {
+                    WithLengths = S8Match(Header.Option, LengthsKeyword);
+                    ErrorPushAssert(WithLengths, &ErrorsArena, Header.OptionAt, S8_SIZE_DATA("unknown option, expected lengths"));
+                }
+                
+                if (PoolTable && PoolLabelIndex != -1 && PoolName.Size)
+                {
+                    i32 Count = PoolTable->ElementsCount;
+                    u64 ScratchPos = ScratchArena.Pos;
+                    u32 *Offsets = (u32 *)ArenaPush(&ScratchArena, sizeof(*Offsets) * Count);
+                    u32 PoolSize = 0;
+                    
+                    s8 *Decoded = (s8 *)ArenaPush(&ScratchArena, sizeof(*Decoded) * Count);
+                    for (i32 RowAt = 0;
+                         RowAt < Count;
+                         RowAt++)
+                    {
+                        s8 Element = TableElement(PoolTable, RowAt, PoolLabelIndex);
+                        Decoded[RowAt].Data = (char *)ArenaPush(&ScratchArena, Element.Size);
+                        Decoded[RowAt].Size = StringElementDecode(Element, Decoded[RowAt].Data);
+                    }
+                    
+                    // NOTE(luca): Open addressing hash table of the rows already written to the pool,
+                    // keyed on the decoded bytes so that eg. plain and "plain" are stored once.
+                    u32 SlotsCount = 1;
+                    while (SlotsCount < 2 * Count) SlotsCount *= 2;
+                    i32 *Slots = (i32 *)ArenaPush(&ScratchArena, sizeof(*Slots) * SlotsCount);
+                    memset(Slots, 0xFF, sizeof(*Slots) * SlotsCount);
+                    
+                    Out += sprintf(Out, "const char %.*s_Pool[] =\n", (int)PoolName.Size, PoolName.Data);
+                    for (i32 RowAt = 0;
+                         RowAt < Count;
+                         RowAt++)
+                    {
+                        s8 String = Decoded[RowAt];
+                        
+                        u32 Hash = 2166136261;
+                        for (u64 ByteAt = 0;
+                             ByteAt < String.Size;
+                             ByteAt++)
+                        {
+                            Hash = (Hash ^ (u8)String.Data[ByteAt]) * 16777619;
+                        }
+                        
+                        u32 SlotAt = Hash & (SlotsCount - 1);
+                        while (Slots[SlotAt] != -1 &&
+                               (Decoded[Slots[SlotAt]].Size != String.Size ||
+                                memcmp(Decoded[Slots[SlotAt]].Data, String.Data, String.Size)))
+                        {
+                            SlotAt = (SlotAt + 1) & (SlotsCount - 1);
+                        }
+                        
+                        if (Slots[SlotAt] != -1)
+                        {
+                            Offsets[RowAt] = Offsets[Slots[SlotAt]];
+                        }
+                        else
+                        {
+                            Slots[SlotAt] = RowAt;
+                            Offsets[RowAt] = PoolSize;
+                            PoolSize += String.Size + 1;
+                            
+                            Out += sprintf(Out, "    \"");
+                            Out = StringElementWrite(Out, TableElement(PoolTable, RowAt, PoolLabelIndex));
+                            Out += sprintf(Out, "\\0\"\n");
+                        }
+                    }
+                    if (!PoolSize)
+                    {
+                        Out += sprintf(Out, "    \"\"\n");
+                    }
+                    Out += sprintf(Out, ";\n\n");
+                    
+                    Out += sprintf(Out, "const unsigned int %.*s_Offsets[] = {", (int)PoolName.Size, PoolName.Data);
+                    for (i32 RowAt = 0;
+                         RowAt < PoolTable->ElementsCount;
+                         RowAt++)
+                    {
+                        Out += sprintf(Out, "%s%u,", (RowAt % 8) ? " " : "\n    ", Offsets[RowAt]);
+                    }
+                    if (!PoolTable->ElementsCount)
+                    {
+                        // NOTE(luca): C does not allow empty arrays, the placeholder points at "".
+                        Out += sprintf(Out, "\n    0,");
+                    }
+                    Out += sprintf(Out, "\n};\n");
+                    
+                    if (WithLengths)
+                    {
+                        Out += sprintf(Out, "\nconst unsigned int %.*s_Lengths[] = {", (int)PoolName.Size, PoolName.Data);
+                        for (i32 RowAt = 0;
+                             RowAt < PoolTable->ElementsCount;
+                             RowAt++)
+                        {
+                            Out += sprintf(Out, "%s%lu,", (RowAt % 8) ? " " : "\n    ", Decoded[RowAt].Size);
+                        }
+                        if (!PoolTable->ElementsCount)
+                        {
+                            Out += sprintf(Out, "\n    0,");
+                        }
+                        Out += sprintf(Out, "\n};\n");
+                    }
+                    
+                    ArenaPop(&ScratchArena, ScratchArena.Pos - ScratchPos);
+                }
+            }
+            else if (!strncmp(In + At, S8_ARG(TableGenEytzingerKeyword)))
+            {
+                directive_header Header = {0};
+                At += TableGenEytzingerKeyword.Size;
+                At = ParseDirectiveHeader(In, InSize, At, Tables, TablesCount, &ErrorsArena, &Header);
+                
+                table *KeysTable  = Header.Table;
+                i32 KeyLabelIndex = Header.LabelIndex;
+                s8 KeysName       = Header.Name;
+                ErrorPushAssert(!Header.Option.Size, &ErrorsArena, Header.OptionAt, S8_SIZE_DATA("unexpected option"));
+                
+                if (KeysTable && KeyLabelIndex != -1 && KeysName.Size)
+                {
+                    i32 Count = KeysTable->ElementsCount;
+                    // NOTE(luca): Keys are unsigned as soon as one of them has a 'u' suffix or does not
+                    // fit in a long long, negative keys then cannot be represented.
+                    b32 AreKeysIntegers = true;
+                    b32 AreKeysUnsigned = false;
+                    s8 NegativeKey = {0};
+                    for (i32 RowAt = 0;
+                         RowAt < Count;
+                         RowAt++)
+                    {
+                        integer Key = {0};
+                        s8 Element = TableElement(KeysTable, RowAt, KeyLabelIndex);
+                        if (!ParseInteger(Element, &Key))
+                        {
+                            ErrorPush(&ErrorsArena, Element.Data - In, S8_SIZE_DATA("key is not an integer"));
+                            AreKeysIntegers = false;
+                        }
+                        else if (Key.IsOverflow)
+                        {
+                            ErrorPush(&ErrorsArena, Element.Data - In, S8_SIZE_DATA("key does not fit in 64 bits"));
+                            AreKeysIntegers = false;
+                        }
+                        else
+                        {
+                            AreKeysUnsigned |= (Key.IsUnsigned || (!Key.IsNegative && Key.Magnitude > INT64_MAX));
+                            if (Key.IsNegative && !NegativeKey.Size) NegativeKey = Element;
+                        }
+                    }
+                    if (AreKeysUnsigned && NegativeKey.Size)
+                    {
+                        ErrorPush(&ErrorsArena, NegativeKey.Data - In, S8_SIZE_DATA("negative key among unsigned keys"));
+                        AreKeysIntegers = false;
+                    }
+                    char *KeyType = (AreKeysUnsigned) ? "unsigned long long" : "long long";
+                    
+                    if (AreKeysIntegers)
+                    {
+                        column_index *Index = TableColumnIndex(&ScratchArena, KeysTable, KeyLabelIndex);
+                        
+                        // NOTE(luca): Slot 0 is unused by the layout, it maps to Count so that a key
+                        // greater than every key in the table gives one past the last row.
+                        u64 SlotsSize = sizeof(i32) * (Count + 1);
+                        i32 *Slots = (i32 *)ArenaPush(&ScratchArena, SlotsSize);
+                        Slots[0] = Count;
+                        EytzingerFill(Index->Rows, Slots, 0, 1, Count);
+                        
+                        // NOTE(luca): Aligned so that the 8 keys at 8K..8K+7, which are the descendants of
+                        // slot K three levels down, sit on a single cache line.
+                        Out += sprintf(Out,
+                                       "#if defined(_MSC_VER)\n"
+                                       "__declspec(align(64))\n"
+                                       "#elif defined(__GNUC__)\n"
+                                       "__attribute__((aligned(64)))\n"
+                                       "#else\n"
+                                       "_Alignas(64)\n"
+                                       "#endif\n"
+                                       "const %s %.*s_Keys[%d] = {", KeyType, (int)KeysName.Size, KeysName.Data, Count + 1);
+                        for (i32 SlotAt = 0;
+                             SlotAt <= Count;
+                             SlotAt++)
+                        {
+                            integer Key = {0};
+                            if (SlotAt)
+                            {
+                                ParseInteger(TableElement(KeysTable, Slots[SlotAt], KeyLabelIndex), &Key);
+                            }
+                            Out += sprintf(Out, "%s", (SlotAt % 8) ? " " : "\n    ");
+                            if (AreKeysUnsigned)
+                            {
+                                Out += sprintf(Out, "0x%lxULL,", Key.Magnitude);
+                            }
+                            else if (Key.IsNegative && Key.Magnitude == (u64)INT64_MAX + 1)
+                            {
+                                // NOTE(luca): 9223372036854775808LL is out of range before negation.
+                                Out += sprintf(Out, "(-%ldLL - 1),", INT64_MAX);
+                            }
+                            else
+                            {
+                                Out += sprintf(Out, "%s%luLL,", (Key.IsNegative) ? "-" : "", Key.Magnitude);
+                            }
+                        }
+                        Out += sprintf(Out, "\n};\n\n");
+                        
+                        Out += sprintf(Out, "const unsigned int %.*s_Rows[%d] = {", (int)KeysName.Size, KeysName.Data, Count + 1);
+                        for (i32 SlotAt = 0;
+                             SlotAt <= Count;
+                             SlotAt++)
+                        {
+                            Out += sprintf(Out, "%s%d,", (SlotAt % 8) ? " " : "\n    ", Slots[SlotAt]);
+                        }
+                        Out += sprintf(Out, "\n};\n\n");
+                        
+                        // NOTE(luca): Every iteration goes down one level without branching on the
+                        // comparison, the prefetch pulls in the cache line holding the descendants
+                        // three levels down.  The trailing ones of At are the right turns taken after
+                        // the last left turn, shifting them out gives the lower bound.
+                        Out += sprintf(Out,
+                                       "static inline unsigned int\n"
+                                       "%.*s_LowerBound(%s Key)\n"
+                                       "{\n"
+                                       "    unsigned int At = 1;\n"
+                                       "    while (At <= %d)\n"
+                                       "    {\n"
+                                       "#if defined(__GNUC__)\n"
+                                       "        // NOTE: Deliberately points past the end of Keys near the leaves,\n"
+                                       "        // a prefetch never faults.\n"
+                                       "        __builtin_prefetch(%.*s_Keys + 8 * At);\n"
+                                       "#endif\n"
+                                       "        At = 2 * At + (%.*s_Keys[At] < Key);\n"
+                                       "    }\n"
+                                       "#if defined(__GNUC__)\n"
+                                       "    At >>= __builtin_ffs(~At);\n"
+                                       "#else\n"
+                                       "    while (At & 1) At >>= 1;\n"
+                                       "    At >>= 1;\n"
+                                       "#endif\n"
+                                       "    return %.*s_Rows[At];\n"
+                                       "}\n",
+                                       (int)KeysName.Size, KeysName.Data, KeyType, Count,
+                                       (int)KeysName.Size, KeysName.Data,
+                                       (int)KeysName.Size, KeysName.Data,
+                                       (int)KeysName.Size, KeysName.Data);
+                        
+                        ArenaPop(&ScratchArena, SlotsSize);
+                    }
+                }
+            }
             else if (!strncmp(In + At, TableGenEnumKeyword.Data, TableGenEnumKeyword.Size))
             {
                 // TODO: not implemented yet